@@ -1,3 +1,6 @@
+#ifdef __linux__
+#define _DEFAULT_SOURCE         /* syscall() for perf_event_open() */
+#endif
 #include <stdint.h>
 #include <limits.h>
 #include <strings.h>
@@ -15,6 +18,11 @@
 #ifdef THREADS
 #include <pthread.h>
 #endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+#endif
 
 typedef struct geopoint {
     double latitude;
@@ -23,6 +31,7 @@ typedef struct geopoint {
     double km_to_meridian;
     double km_to_equator;
     uint64_t id;
+    uint64_t weight;            /* number of input points this one stands for */
     uint64_t dist[6];           /* 50, 25, 10, 5, 2, 1 KM */
 } geopoint_t;
 
@@ -67,6 +76,7 @@ struct thread_info {            /* Used as argument to thread_start() */
     uint64_t n_landmarks;
     const char *type_hotels;
     double t0;
+    double window;
     uint64_t count;
     uint64_t swapped;
 };
@@ -81,12 +91,12 @@ struct thread_info {            /* Used as argument to thread_start() */
 #define NUM_THREADS 4
 #endif
 
-#define INCR(v) __atomic_add_fetch(&v,1,__ATOMIC_SEQ_CST)
+#define ADD(v,n) __atomic_add_fetch(&v,n,__ATOMIC_SEQ_CST)
 #define INTERSECT partition_intersect_hotels
 #define _THREADS 1
 #else                           /* !THREADS */
 #define INTERSECT intersect_hotels
-#define INCR(v) v++
+#define ADD(v,n) v += (n)
 #define _THREADS 0
 #endif                          /* THREADS */
 
@@ -97,6 +107,83 @@ double dtime()
     return (double)tv.tv_sec + ((double)tv.tv_usec / 1000000.0);
 }
 
+/* Cache counters around the join: L1D read misses are what L2 sees, LLC read
+ * accesses are what L2 missed, so both miss rates fall out of three events.
+ * A NULL fds turns both calls into no-ops. */
+#define CACHE_L1D_MISS 0
+#define CACHE_LL_ACCESS 1
+#define CACHE_LL_MISS 2
+#define CACHE_EVENTS 3
+
+#ifdef __linux__
+static void cache_counters_start(int *fds)
+{
+    static const uint64_t config[CACHE_EVENTS] = {
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16),
+        PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    };
+    struct perf_event_attr pe;
+    int i;
+
+    if (!fds)
+        return;
+    for (i = 0; i < CACHE_EVENTS; i++) {
+        memset(&pe, 0, sizeof(pe));
+        pe.type = PERF_TYPE_HW_CACHE;
+        pe.size = sizeof(pe);
+        pe.config = config[i];
+        pe.disabled = 1;
+        pe.inherit = 1;         /* count the join threads too */
+        pe.exclude_kernel = 1;
+        pe.exclude_hv = 1;
+        fds[i] = syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+        if (fds[i] < 0) {
+            printf("Cache counters unavailable: %s\n", strerror(errno));
+            while (i-- > 0)
+                close(fds[i]);
+            fds[0] = -1;
+            return;
+        }
+    }
+    for (i = 0; i < CACHE_EVENTS; i++) {
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static void cache_counters_report(int *fds)
+{
+    uint64_t count[CACHE_EVENTS];
+    int i;
+
+    if (!fds || fds[0] < 0)
+        return;
+    for (i = 0; i < CACHE_EVENTS; i++) {
+        ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fds[i], &count[i], sizeof(uint64_t)) != sizeof(uint64_t))
+            count[i] = 0;
+        close(fds[i]);
+    }
+    printf("L2 read miss rate %.2f%% (%ju of %ju), LLC read miss rate %.2f%% (%ju of %ju)\n",
+           count[CACHE_L1D_MISS] ? (double)count[CACHE_LL_ACCESS] / (double)count[CACHE_L1D_MISS] * 100.0 : 0.0,
+           (uintmax_t) count[CACHE_LL_ACCESS], (uintmax_t) count[CACHE_L1D_MISS],
+           count[CACHE_LL_ACCESS] ? (double)count[CACHE_LL_MISS] / (double)count[CACHE_LL_ACCESS] * 100.0 : 0.0,
+           (uintmax_t) count[CACHE_LL_MISS], (uintmax_t) count[CACHE_LL_ACCESS]);
+}
+#else
+static void cache_counters_start(int *fds)
+{
+    if (fds)
+        fds[0] = -1;
+}
+
+static void cache_counters_report(int *fds)
+{
+    (void)fds;
+}
+#endif
+
 geopoint_t *binsearch_start(geopoint_t * key, geopoint_t * points, uint64_t n)
 {
     uint64_t l = 0;
@@ -152,6 +239,7 @@ static inline geopoint_t *read_geopoints(char *filename, uint64_t * count, char
 
     while (3 == fscanf(f_points, "%ju\t%lf\t%lf\n", &tmp_id, &point->latitude, &point->longitude)) {
         point->id = tmp_id;
+        point->weight = 1;
         point->km_long_mul = (KM_LONG_MUL * cos(deg2rad(point->latitude)));
         point->km_to_meridian = point->longitude * point->km_long_mul;
         point->km_to_equator = point->latitude * KM_LAT;
@@ -181,23 +269,118 @@ static inline geopoint_t *read_geopoints(char *filename, uint64_t * count, char
     return points;
 }
 
+/* points must be sorted with cmp_geopoint, so exact (lat, long) duplicates are adjacent.
+ * Returns a new array holding one point per run, with weight set to the run length. */
+static inline geopoint_t *collapse_geopoints(geopoint_t * const points, const uint64_t n_points, uint64_t * count,
+                                             const char *type)
+{
+    const geopoint_t *points_end = points + n_points;
+    geopoint_t *reps = malloc(sizeof(geopoint_t) * (n_points ? n_points : 1));
+    geopoint_t *point;
+    uint64_t n = 0;
+    double t0 = dtime();
+
+    assert(reps);
+    for (point = points; point < points_end; point++) {
+        if (n && reps[n - 1].latitude == point->latitude && reps[n - 1].longitude == point->longitude) {
+            reps[n - 1].weight++;
+        } else {
+            reps[n++] = *point;
+        }
+    }
+    *count = n;
+
+    printf("Collapsed %ju %s to %ju unique points (%.2f%%) in %.2fsecs\n",
+           (uintmax_t) n_points, type, (uintmax_t) * count,
+           n_points ? (double)*count / (double)n_points * 100.0 : 100.0, SECS(dtime() - t0));
+    return reps;
+}
+
+/* copy the counts of each collapsed point back to every point of the run it stands for */
+static inline void expand_geopoints(geopoint_t * const reps, const uint64_t n_reps, geopoint_t * const points)
+{
+    const geopoint_t *reps_end = reps + n_reps;
+    geopoint_t *point = points;
+    geopoint_t *rep;
+    uint64_t i;
+
+    for (rep = reps; rep < reps_end; rep++) {
+        for (i = 0; i < rep->weight; i++, point++)
+            memcpy(point->dist, rep->dist, sizeof(uint64_t) * 6);
+    }
+}
+
+/* number of pairs the sweep measures: every landmark within window of a hotel's latitude.
+ * Both sets must be sorted with cmp_geopoint. */
+static inline uint64_t sweep_candidates(const geopoint_t * hotels, const uint64_t n_hotels,
+                                        const geopoint_t * landmarks, const uint64_t n_landmarks, const double window)
+{
+    uint64_t i, lo = 0, hi = 0;
+    uint64_t sum = 0;
+
+    for (i = 0; i < n_hotels; i++) {
+        while (lo < n_landmarks && landmarks[lo].km_to_equator - hotels[i].km_to_equator < -window)
+            lo++;
+        if (hi < lo)
+            hi = lo;
+        while (hi < n_landmarks && landmarks[hi].km_to_equator - hotels[i].km_to_equator <= window)
+            hi++;
+        sum += hi - lo;
+    }
+    return sum;
+}
+
+/* dist_sq must already be known to be within D0. count_pair() counts with ADD, which is
+ * atomic in the THREADS build; count_pair_plain() is for joins that own the points they touch. */
+#define DEFINE_COUNT_PAIR(name, add) \
+static inline void name(geopoint_t * hotel, geopoint_t * landmark, const double dist_sq) \
+{                                                                                        \
+    add(hotel->dist[0], landmark->weight);                                               \
+    add(landmark->dist[0], hotel->weight);                                               \
+    if (UNLIKELY(dist_sq <= D1)) {                                                       \
+        add(landmark->dist[1], hotel->weight);                                           \
+        add(hotel->dist[1], landmark->weight);                                           \
+        if (UNLIKELY(dist_sq <= D2)) {                                                   \
+            add(landmark->dist[2], hotel->weight);                                       \
+            add(hotel->dist[2], landmark->weight);                                       \
+            if (UNLIKELY(dist_sq <= D3)) {                                               \
+                add(hotel->dist[3], landmark->weight);                                   \
+                add(landmark->dist[3], hotel->weight);                                   \
+                if (UNLIKELY(dist_sq <= D4)) {                                           \
+                    add(hotel->dist[4], landmark->weight);                               \
+                    add(landmark->dist[4], hotel->weight);                               \
+                    if (UNLIKELY(dist_sq <= D5)) {                                       \
+                        add(hotel->dist[5], landmark->weight);                           \
+                        add(landmark->dist[5], hotel->weight);                           \
+                    }                                                                    \
+                }                                                                        \
+            }                                                                            \
+        }                                                                                \
+    }                                                                                    \
+}
+
+#define PLAIN_ADD(v,n) v += (n)
+DEFINE_COUNT_PAIR(count_pair, ADD)
+DEFINE_COUNT_PAIR(count_pair_plain, PLAIN_ADD)
+
+/* window is the largest distance the caller needs counted, 50km normally */
 static inline geopoint_t *scan_landmarks(geopoint_t * hotel, geopoint_t * lmw_start, const geopoint_t * landmarks_end,
-                                         uint64_t swapped)
+                                         uint64_t swapped, const double window)
 {
     geopoint_t *landmark;
     for (landmark = lmw_start; landmark < landmarks_end; landmark++) {
         double lat_dist = landmark->km_to_equator - hotel->km_to_equator;
 
-        if (UNLIKELY(lat_dist < -50.0)) {
+        if (UNLIKELY(lat_dist < -window)) {
             lmw_start = landmark + 1;
             continue;
-        } else if (UNLIKELY(lat_dist > 50.0)) {
+        } else if (UNLIKELY(lat_dist > window)) {
             break;
         } else {
             double long_dist = fabs((landmark->longitude - hotel->longitude) *
                                     (swapped ? hotel->km_long_mul : landmark->km_long_mul));
 
-            if (UNLIKELY(long_dist < 50.0)) {
+            if (UNLIKELY(long_dist < window)) {
                 double lat_dist_sq = SQR(lat_dist);
                 double long_dist_sq = SQR(long_dist);
                 double dist_sq = long_dist_sq + lat_dist_sq;
@@ -209,28 +392,7 @@ static inline geopoint_t *scan_landmarks(geopoint_t * hotel, geopoint_t * lmw_st
                                (uintmax_t) hotel->id, (uintmax_t) landmark->id, sqrt(dist_sq), hotel->latitude,
                                hotel->longitude, landmark->latitude, landmark->longitude, (uintmax_t) swapped);
                     }
-                    INCR(hotel->dist[0]);
-                    INCR(landmark->dist[0]);
-                    if (UNLIKELY(dist_sq <= D1)) {
-                        INCR(landmark->dist[1]);
-                        INCR(hotel->dist[1]);
-                        if (UNLIKELY(dist_sq <= D2)) {
-                            INCR(landmark->dist[2]);
-                            INCR(hotel->dist[2]);
-                            if (UNLIKELY(dist_sq <= D3)) {
-                                INCR(hotel->dist[3]);
-                                INCR(landmark->dist[3]);
-                                if (UNLIKELY(dist_sq <= D4)) {
-                                    INCR(hotel->dist[4]);
-                                    INCR(landmark->dist[4]);
-                                    if (UNLIKELY(dist_sq <= D5)) {
-                                        INCR(hotel->dist[5]);
-                                        INCR(landmark->dist[5]);
-                                    }
-                                }
-                            }
-                        }
-                    }
+                    count_pair(hotel, landmark, dist_sq);
                 }
             }
         }
@@ -240,7 +402,8 @@ static inline geopoint_t *scan_landmarks(geopoint_t * hotel, geopoint_t * lmw_st
 
 inline static uint64_t intersect_hotels(geopoint_t * const hotels, const uint64_t n_hotels,
                                         geopoint_t * const landmarks, const uint64_t n_landmarks,
-                                        const uint64_t swapped, const char *type_hotels, double t0)
+                                        const uint64_t swapped, const char *type_hotels, double t0,
+                                        const double window)
 {
     const geopoint_t *hotels_end = hotels + n_hotels;
     const geopoint_t *landmarks_end = landmarks + n_landmarks;
@@ -250,7 +413,7 @@ inline static uint64_t intersect_hotels(geopoint_t * const hotels, const uint64_
     double last_elapsed = 0.0;
 
     for (hotel = hotels; hotel < hotels_end; hotel++) {
-        lmw_start = scan_landmarks(hotel, lmw_start, landmarks_end, swapped);
+        lmw_start = scan_landmarks(hotel, lmw_start, landmarks_end, swapped, window);
         if (++count % 100 == 0) {
             const double t1 = dtime();
             const double elapsed = SECS(t1 - t0);
@@ -266,6 +429,540 @@ inline static uint64_t intersect_hotels(geopoint_t * const hotels, const uint64_
     return count;
 }
 
+/* --engine tiles: both sets are copied in Hilbert order and cut into tiles small enough for a pair
+ * of them to stay in L2. Each hotel tile is joined against every landmark tile within the window
+ * as a dense block, so every landmark fetched is reused by the whole hotel tile, and the next
+ * hotel tile along the curve usually wants the same landmark tiles again. The join runs on
+ * one thread, so it counts with count_pair_plain() even in the THREADS build. */
+#ifndef TILE_POINTS
+#define TILE_POINTS 1024        /* two tiles of geopoint_t are about 200KB */
+#endif
+#define TILE_MAX_KM 25.0        /* keeps tiles in sparse areas from spanning continents */
+#define HILBERT_SIDE 65536      /* cells per axis */
+#define TILE_BAND_KM 50.0       /* latitude band height of the landmark tile index */
+#define TILE_BANDS ((uint64_t)(180.0 * KM_LAT / TILE_BAND_KM) + 1)
+
+typedef struct tile {
+    geopoint_t *points;
+    uint64_t n_points;
+    double min_km_to_equator;
+    double max_km_to_equator;
+    double min_longitude;
+    double max_longitude;
+    double min_km_long_mul;
+} tile_t;
+
+/* landmark tiles bucketed by the band of their southern edge, sorted by western edge in a band */
+typedef struct tile_index {
+    tile_t **tiles;
+    uint64_t *band_start;       /* band b is tiles[band_start[b] .. band_start[b + 1] - 1] */
+    double *band_min_mul;       /* smallest km_long_mul of any tile in band b */
+    double *band_max_span;      /* widest longitude span of any tile in band b */
+} tile_index_t;
+
+typedef struct hilbert_key {
+    uint64_t key;
+    uint64_t index;
+} hilbert_key_t;
+
+static inline uint64_t hilbert_cell(const double offset, const double span)
+{
+    double c = offset / span * HILBERT_SIDE;
+    if (c < 0.0)
+        return 0;
+    if (c >= HILBERT_SIDE - 1)
+        return HILBERT_SIDE - 1;
+    return (uint64_t) c;
+}
+
+/* distance of cell (x, y) along the Hilbert curve filling the HILBERT_SIDE square */
+static inline uint64_t hilbert_index(uint64_t x, uint64_t y)
+{
+    uint64_t s, rx, ry, t;
+    uint64_t d = 0;
+
+    for (s = HILBERT_SIDE / 2; s > 0; s /= 2) {
+        rx = (x & s) > 0;
+        ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = HILBERT_SIDE - 1 - x;
+                y = HILBERT_SIDE - 1 - y;
+            }
+            t = x;
+            x = y;
+            y = t;
+        }
+    }
+    return d;
+}
+
+int cmp_hilbert_key(const void *va, const void *vb)
+{
+    hilbert_key_t *a = (hilbert_key_t *) va;
+    hilbert_key_t *b = (hilbert_key_t *) vb;
+    int c = CMP(a->key, b->key);
+    if (c)
+        return c;
+    return CMP(a->index, b->index);
+}
+
+static inline uint64_t tile_band(const double km_to_equator)
+{
+    double b = floor((km_to_equator + 90.0 * KM_LAT) / TILE_BAND_KM);
+    if (b < 0.0)
+        return 0;
+    if (b >= (double)(TILE_BANDS - 1))
+        return TILE_BANDS - 1;
+    return (uint64_t) b;
+}
+
+int cmp_tile_ptr(const void *va, const void *vb)
+{
+    tile_t *a = *(tile_t **) va;
+    tile_t *b = *(tile_t **) vb;
+    int c = CMP(tile_band(a->min_km_to_equator), tile_band(b->min_km_to_equator));
+    if (c)
+        return c;
+    return CMP(a->min_longitude, b->min_longitude);
+}
+
+/* returns a copy of points in Hilbert order, order[i] is the index in points of copy[i] */
+static geopoint_t *hilbert_copy(geopoint_t * const points, const uint64_t n_points, uint64_t ** order)
+{
+    hilbert_key_t *keys = malloc(sizeof(hilbert_key_t) * (n_points ? n_points : 1));
+    geopoint_t *copy = malloc(sizeof(geopoint_t) * (n_points ? n_points : 1));
+    uint64_t i;
+
+    *order = malloc(sizeof(uint64_t) * (n_points ? n_points : 1));
+    assert(keys && copy && *order);
+
+    for (i = 0; i < n_points; i++) {
+        keys[i].key = hilbert_index(hilbert_cell(points[i].longitude + 180.0, 360.0),
+                                    hilbert_cell(points[i].latitude + 90.0, 180.0));
+        keys[i].index = i;
+    }
+    qsort(keys, n_points, sizeof(hilbert_key_t), cmp_hilbert_key);
+
+    for (i = 0; i < n_points; i++) {
+        copy[i] = points[keys[i].index];
+        (*order)[i] = keys[i].index;
+    }
+    free(keys);
+    return copy;
+}
+
+static inline int tile_fits(const tile_t * tile, const geopoint_t * point)
+{
+    double min_y = fmin(tile->min_km_to_equator, point->km_to_equator);
+    double max_y = fmax(tile->max_km_to_equator, point->km_to_equator);
+    double min_x = fmin(tile->min_longitude, point->longitude);
+    double max_x = fmax(tile->max_longitude, point->longitude);
+
+    return tile->n_points < TILE_POINTS && max_y - min_y <= TILE_MAX_KM &&
+        (max_x - min_x) * point->km_long_mul <= TILE_MAX_KM;
+}
+
+/* cut Hilbert ordered points into runs of at most TILE_POINTS that stay within TILE_MAX_KM */
+static tile_t *build_tiles(geopoint_t * const points, const uint64_t n_points, uint64_t * n_tiles)
+{
+    const geopoint_t *points_end = points + n_points;
+    tile_t *tiles = malloc(sizeof(tile_t) * (n_points ? n_points : 1));
+    tile_t *tile = NULL;
+    geopoint_t *point;
+    uint64_t n = 0;
+
+    assert(tiles);
+    for (point = points; point < points_end; point++) {
+        if (!n || !tile_fits(tile, point)) {
+            tile = tiles + n++;
+            tile->points = point;
+            tile->n_points = 1;
+            tile->min_km_to_equator = tile->max_km_to_equator = point->km_to_equator;
+            tile->min_longitude = tile->max_longitude = point->longitude;
+            tile->min_km_long_mul = point->km_long_mul;
+        } else {
+            tile->n_points++;
+            tile->min_km_to_equator = fmin(tile->min_km_to_equator, point->km_to_equator);
+            tile->max_km_to_equator = fmax(tile->max_km_to_equator, point->km_to_equator);
+            tile->min_longitude = fmin(tile->min_longitude, point->longitude);
+            tile->max_longitude = fmax(tile->max_longitude, point->longitude);
+            tile->min_km_long_mul = fmin(tile->min_km_long_mul, point->km_long_mul);
+        }
+    }
+    *n_tiles = n;
+    return tiles;
+}
+
+static void build_tile_index(tile_index_t * index, tile_t * const tiles, const uint64_t n_tiles)
+{
+    uint64_t i, b;
+
+    index->tiles = malloc(sizeof(tile_t *) * (n_tiles ? n_tiles : 1));
+    index->band_start = calloc(TILE_BANDS + 1, sizeof(uint64_t));
+    index->band_min_mul = malloc(sizeof(double) * TILE_BANDS);
+    index->band_max_span = malloc(sizeof(double) * TILE_BANDS);
+    assert(index->tiles && index->band_start && index->band_min_mul && index->band_max_span);
+
+    for (b = 0; b < TILE_BANDS; b++) {
+        index->band_min_mul[b] = KM_LONG_MUL;
+        index->band_max_span[b] = 0.0;
+    }
+    for (i = 0; i < n_tiles; i++) {
+        b = tile_band(tiles[i].min_km_to_equator);
+        index->tiles[i] = tiles + i;
+        index->band_start[b + 1]++;
+        index->band_min_mul[b] = fmin(index->band_min_mul[b], tiles[i].min_km_long_mul);
+        index->band_max_span[b] = fmax(index->band_max_span[b], tiles[i].max_longitude - tiles[i].min_longitude);
+    }
+    for (b = 0; b < TILE_BANDS; b++)
+        index->band_start[b + 1] += index->band_start[b];
+    qsort(index->tiles, n_tiles, sizeof(tile_t *), cmp_tile_ptr);
+}
+
+static void free_tile_index(tile_index_t * index)
+{
+    free(index->tiles);
+    free(index->band_start);
+    free(index->band_min_mul);
+    free(index->band_max_span);
+}
+
+/* lower bound for the squared distance between any hotel of a and any landmark of b */
+static inline double tile_gap_sq(const tile_t * a, const tile_t * b, const uint64_t swapped)
+{
+    double lat_gap = fmax(0.0, fmax(b->min_km_to_equator - a->max_km_to_equator,
+                                    a->min_km_to_equator - b->max_km_to_equator));
+    double long_gap = fmax(0.0, fmax(b->min_longitude - a->max_longitude, a->min_longitude - b->max_longitude)) *
+        (swapped ? a->min_km_long_mul : b->min_km_long_mul);
+    return SQR(lat_gap) + SQR(long_gap);
+}
+
+static inline void join_tiles(const tile_t * a, const tile_t * b, const uint64_t swapped)
+{
+    geopoint_t *const hotels_end = a->points + a->n_points;
+    geopoint_t *const landmarks_end = b->points + b->n_points;
+    geopoint_t *hotel;
+    geopoint_t *landmark;
+
+    for (hotel = a->points; hotel < hotels_end; hotel++) {
+        for (landmark = b->points; landmark < landmarks_end; landmark++) {
+            double lat_dist = landmark->km_to_equator - hotel->km_to_equator;
+            double long_dist = (landmark->longitude - hotel->longitude) *
+                (swapped ? hotel->km_long_mul : landmark->km_long_mul);
+            double dist_sq = SQR(long_dist) + SQR(lat_dist);
+
+            if (UNLIKELY(dist_sq <= D0))
+                count_pair_plain(hotel, landmark, dist_sq);
+        }
+    }
+}
+
+static inline void copy_back_dist(geopoint_t * const points, const geopoint_t * copy, const uint64_t * order,
+                                  const uint64_t n_points)
+{
+    uint64_t i;
+    for (i = 0; i < n_points; i++)
+        memcpy(points[order[i]].dist, copy[i].dist, sizeof(uint64_t) * 6);
+}
+
+static uint64_t intersect_tiles(geopoint_t * const hotels, const uint64_t n_hotels,
+                                geopoint_t * const landmarks, const uint64_t n_landmarks,
+                                const uint64_t swapped, const char *type_hotels, double t0, const double window,
+                                int *cache_fds)
+{
+    uint64_t *hotel_order;
+    uint64_t *landmark_order;
+    geopoint_t *hotel_copy = hilbert_copy(hotels, n_hotels, &hotel_order);
+    geopoint_t *landmark_copy = hilbert_copy(landmarks, n_landmarks, &landmark_order);
+    uint64_t n_hotel_tiles, n_landmark_tiles;
+    tile_t *hotel_tiles = build_tiles(hotel_copy, n_hotels, &n_hotel_tiles);
+    tile_t *landmark_tiles = build_tiles(landmark_copy, n_landmarks, &n_landmark_tiles);
+    tile_index_t index;
+    tile_t *a;
+    uint64_t count = 0;
+    uint64_t n_pairs = 0;
+    double last_elapsed = 0.0;
+
+    build_tile_index(&index, landmark_tiles, n_landmark_tiles);
+
+    printf("Cut %s into %ju tiles and the other set into %ju tiles in %.2fsecs\n",
+           type_hotels, (uintmax_t) n_hotel_tiles, (uintmax_t) n_landmark_tiles, SECS(dtime() - t0));
+
+    cache_counters_start(cache_fds);
+    for (a = hotel_tiles; a < hotel_tiles + n_hotel_tiles; a++) {
+        /* landmark tiles span at most TILE_MAX_KM, so no candidate starts lower than this */
+        const uint64_t b_end = tile_band(a->max_km_to_equator + window);
+        uint64_t b;
+
+        for (b = tile_band(a->min_km_to_equator - window - TILE_MAX_KM); b <= b_end; b++) {
+            /* widest longitude gap that can still be within window, and where candidates start */
+            const double mul = swapped ? a->min_km_long_mul : index.band_min_mul[b];
+            const double long_window = mul > 0.0 ? window / mul : 360.0;
+            const double long_lo = a->min_longitude - long_window - index.band_max_span[b];
+            const double long_hi = a->max_longitude + long_window;
+            uint64_t l = index.band_start[b];
+            uint64_t h = index.band_start[b + 1];
+
+            while (l < h) {
+                uint64_t mid = (l + h) / 2;
+                if (long_lo <= index.tiles[mid]->min_longitude) {
+                    h = mid;
+                } else {
+                    l = mid + 1;
+                }
+            }
+            for (; l < index.band_start[b + 1] && index.tiles[l]->min_longitude <= long_hi; l++) {
+                if (tile_gap_sq(a, index.tiles[l], swapped) <= SQR(window)) {
+                    join_tiles(a, index.tiles[l], swapped);
+                    n_pairs++;
+                }
+            }
+        }
+
+        count += a->n_points;
+        if ((a - hotel_tiles + 1) % 100 == 0) {
+            const double t1 = dtime();
+            const double elapsed = SECS(t1 - t0);
+            if (elapsed - last_elapsed >= 1.0) {
+                printf("Processed %.2f%% (%ju) of %s in %.2fsecs @ %.2f/sec\r",
+                       (double)count / (double)n_hotels * 100.0, (uintmax_t) count, type_hotels, SECS(t1 - t0),
+                       count / SECS(t1 - t0));
+                fflush(stdout);
+                last_elapsed = elapsed;
+            }
+        }
+    }
+    cache_counters_report(cache_fds);
+    printf("Joined %ju tile pairs, %.1f landmark tiles per %s tile\n",
+           (uintmax_t) n_pairs, n_hotel_tiles ? (double)n_pairs / (double)n_hotel_tiles : 0.0, type_hotels);
+
+    copy_back_dist(hotels, hotel_copy, hotel_order, n_hotels);
+    copy_back_dist(landmarks, landmark_copy, landmark_order, n_landmarks);
+    free_tile_index(&index);
+    free(hotel_tiles);
+    free(landmark_tiles);
+    free(hotel_copy);
+    free(landmark_copy);
+    free(hotel_order);
+    free(landmark_order);
+    return count;
+}
+
+/* --approx-wide: sparse latitude rows of the other set, sorted by longitude, with a prefix sum
+ * over the row-sorted weights. Runs wholly inside the disc come from the prefix sum, points on
+ * the edge of the disc are measured exactly. */
+#ifndef GRID_ROW_DEG
+#define GRID_ROW_DEG 0.02       /* about 2.2km */
+#endif
+#define GRID_ROWS ((uint64_t)(180.0 / GRID_ROW_DEG) + 1)
+#define GRID_EPS_DEG 1e-9       /* slack for rounding when bucketing a latitude into a row */
+#define APPROX_BANDS 3          /* dist[0 .. APPROX_BANDS - 1] come from the grid */
+#define APPROX_WINDOW 5.0       /* largest band the sweep still counts */
+
+static const double approx_radius[APPROX_BANDS] = { 50.0, 25.0, 10.0 };
+
+typedef struct grid_point {
+    double km_to_equator;
+    double longitude;
+    double km_long_mul;
+    uint64_t weight;
+    uint64_t row;
+} grid_point_t;
+
+typedef struct density_grid {
+    grid_point_t *points;
+    double *longitude;          /* points[i].longitude, packed for the binary searches */
+    uint64_t *weight_sum;       /* weight_sum[i] is the weight of points[0 .. i-1] */
+    uint64_t *row_start;        /* row r is points[row_start[r] .. row_start[r + 1] - 1] */
+    double *row_mul_min;        /* smallest km_long_mul inside row r */
+    double *row_mul_max;        /* largest km_long_mul inside row r */
+    uint64_t point_mul;         /* distances use the grid point's km_long_mul rather than the query's */
+} density_grid_t;
+
+static inline uint64_t grid_row(const double latitude)
+{
+    double r = floor((latitude + 90.0) / GRID_ROW_DEG);
+    if (r < 0.0)
+        return 0;
+    if (r >= (double)(GRID_ROWS - 1))
+        return GRID_ROWS - 1;
+    return (uint64_t) r;
+}
+
+int cmp_grid_point(const void *va, const void *vb)
+{
+    grid_point_t *a = (grid_point_t *) va;
+    grid_point_t *b = (grid_point_t *) vb;
+    int c = CMP(a->row, b->row);
+    if (c)
+        return c;
+    return CMP(a->longitude, b->longitude);
+}
+
+static void build_grid(density_grid_t * grid, geopoint_t * const points, const uint64_t n_points,
+                       const uint64_t point_mul)
+{
+    uint64_t i, r;
+
+    grid->points = malloc(sizeof(grid_point_t) * (n_points ? n_points : 1));
+    grid->longitude = malloc(sizeof(double) * (n_points ? n_points : 1));
+    grid->weight_sum = malloc(sizeof(uint64_t) * (n_points + 1));
+    grid->row_start = calloc(GRID_ROWS + 1, sizeof(uint64_t));
+    grid->row_mul_min = malloc(sizeof(double) * GRID_ROWS);
+    grid->row_mul_max = malloc(sizeof(double) * GRID_ROWS);
+    grid->point_mul = point_mul;
+    assert(grid->points && grid->longitude && grid->weight_sum);
+    assert(grid->row_start && grid->row_mul_min && grid->row_mul_max);
+
+    for (i = 0; i < n_points; i++) {
+        grid->points[i].km_to_equator = points[i].km_to_equator;
+        grid->points[i].longitude = points[i].longitude;
+        grid->points[i].km_long_mul = points[i].km_long_mul;
+        grid->points[i].weight = points[i].weight;
+        grid->points[i].row = grid_row(points[i].latitude);
+    }
+    qsort(grid->points, n_points, sizeof(grid_point_t), cmp_grid_point);
+
+    grid->weight_sum[0] = 0;
+    for (i = 0; i < n_points; i++) {
+        grid->longitude[i] = grid->points[i].longitude;
+        grid->weight_sum[i + 1] = grid->weight_sum[i] + grid->points[i].weight;
+        grid->row_start[grid->points[i].row + 1]++;
+    }
+    for (r = 0; r < GRID_ROWS; r++) {
+        double lat0 = fabs(r * GRID_ROW_DEG - 90.0);
+        double lat1 = fabs((r + 1) * GRID_ROW_DEG - 90.0);
+        double lat_min = (r * GRID_ROW_DEG - 90.0 <= 0.0 && (r + 1) * GRID_ROW_DEG - 90.0 >= 0.0) ? 0.0 :
+            (lat0 < lat1 ? lat0 : lat1);
+        double lat_max = lat0 > lat1 ? lat0 : lat1;
+
+        grid->row_start[r + 1] += grid->row_start[r];
+        grid->row_mul_max[r] = KM_LONG_MUL * cos(deg2rad(lat_min));
+        grid->row_mul_min[r] = lat_max >= 90.0 ? 0.0 : KM_LONG_MUL * cos(deg2rad(lat_max));
+    }
+}
+
+static void free_grid(density_grid_t * grid)
+{
+    free(grid->points);
+    free(grid->longitude);
+    free(grid->weight_sum);
+    free(grid->row_start);
+    free(grid->row_mul_min);
+    free(grid->row_mul_max);
+}
+
+/* first index in [l, h) whose longitude is >= lon, or > lon when after is set */
+static inline uint64_t grid_bound(const double *longitude, uint64_t l, uint64_t h, const double lon,
+                                  const int after)
+{
+    while (l < h) {
+        uint64_t mid = (l + h) / 2;
+        if (after ? longitude[mid] > lon : longitude[mid] >= lon) {
+            h = mid;
+        } else {
+            l = mid + 1;
+        }
+    }
+    return l;
+}
+
+static inline uint64_t grid_point_weight(const density_grid_t * grid, const grid_point_t * p,
+                                         const geopoint_t * q, const double radius_sq)
+{
+    double lat_dist = p->km_to_equator - q->km_to_equator;
+    double long_dist = (p->longitude - q->longitude) * (grid->point_mul ? p->km_long_mul : q->km_long_mul);
+    return SQR(long_dist) + SQR(lat_dist) <= radius_sq ? p->weight : 0;
+}
+
+/* weight of the grid points within radius of q. Per row the longitude range that is wholly
+ * inside the disc is summed from weight_sum, only the points on the edge are measured. */
+static inline uint64_t grid_count(const density_grid_t * grid, const geopoint_t * q, const double radius)
+{
+    const double radius_sq = SQR(radius);
+    const double lat_span = radius / KM_LAT;
+    const uint64_t r_end = grid_row(q->latitude + lat_span);
+    uint64_t r;
+    uint64_t sum = 0;
+
+    for (r = grid_row(q->latitude - lat_span); r <= r_end; r++) {
+        const uint64_t l = grid->row_start[r];
+        const uint64_t h = grid->row_start[r + 1];
+        double dy0, dy1, dy_min, dy_max, mul_min, mul_max, half;
+        uint64_t o0, o1, i0, i1, i;
+
+        if (l == h)
+            continue;
+
+        dy0 = (r * GRID_ROW_DEG - 90.0 - GRID_EPS_DEG) * KM_LAT - q->km_to_equator;
+        dy1 = ((r + 1) * GRID_ROW_DEG - 90.0 + GRID_EPS_DEG) * KM_LAT - q->km_to_equator;
+        dy_min = dy0 > 0.0 ? dy0 : dy1 < 0.0 ? -dy1 : 0.0;
+        dy_max = fabs(dy0) > fabs(dy1) ? fabs(dy0) : fabs(dy1);
+        if (dy_min > radius)
+            continue;
+
+        if (grid->point_mul) {
+            mul_min = grid->row_mul_min[r];
+            mul_max = grid->row_mul_max[r];
+        } else {
+            mul_min = mul_max = q->km_long_mul;
+        }
+
+        half = mul_min > 0.0 ? sqrt(radius_sq - SQR(dy_min)) / mul_min : 360.0;
+        o0 = grid_bound(grid->longitude, l, h, q->longitude - half, 0);
+        o1 = grid_bound(grid->longitude, o0, h, q->longitude + half, 1);
+
+        if (dy_max < radius) {
+            half = sqrt(radius_sq - SQR(dy_max)) / mul_max;
+            i0 = grid_bound(grid->longitude, o0, o1, q->longitude - half, 0);
+            i1 = grid_bound(grid->longitude, i0, o1, q->longitude + half, 1);
+            sum += grid->weight_sum[i1] - grid->weight_sum[i0];
+        } else {
+            i0 = i1 = o1;
+        }
+
+        for (i = o0; i < i0; i++)
+            sum += grid_point_weight(grid, grid->points + i, q, radius_sq);
+        for (i = i1; i < o1; i++)
+            sum += grid_point_weight(grid, grid->points + i, q, radius_sq);
+    }
+    return sum;
+}
+
+static inline void grid_count_points(const density_grid_t * grid, geopoint_t * const points, const uint64_t n_points)
+{
+    const geopoint_t *points_end = points + n_points;
+    geopoint_t *point;
+    int b;
+
+    for (point = points; point < points_end; point++) {
+        for (b = 0; b < APPROX_BANDS; b++)
+            point->dist[b] = grid_count(grid, point, approx_radius[b]);
+    }
+}
+
+/* overwrite the wide bands of both sets with the grid answer, the sweep must already have run */
+static void approx_wide_bands(geopoint_t * const hotels, const uint64_t n_hotels,
+                              geopoint_t * const landmarks, const uint64_t n_landmarks, const uint64_t swapped)
+{
+    density_grid_t grid;
+    double t0 = dtime();
+
+    /* distances are always measured with the original landmark's km_long_mul, see scan_landmarks() */
+    build_grid(&grid, landmarks, n_landmarks, !swapped);
+    grid_count_points(&grid, hotels, n_hotels);
+    free_grid(&grid);
+
+    build_grid(&grid, hotels, n_hotels, swapped);
+    grid_count_points(&grid, landmarks, n_landmarks);
+    free_grid(&grid);
+
+    printf("Counted the %.0f/%.0f/%.0fkm bands from density grids in %.2fsecs\n",
+           approx_radius[0], approx_radius[1], approx_radius[2], SECS(dtime() - t0));
+}
+
 void print_results(const char *outname, geopoint_t * const landmarks, const uint64_t n_landmarks)
 {
     const geopoint_t *landmarks_end = landmarks + n_landmarks;
@@ -293,7 +990,7 @@ static void *thread_start(void *arg)
     printf("thread start thread %ju; count: %ju hotels\n", (uintmax_t) tinfo->thread_num, (uintmax_t) tinfo->n_hotels);
     tinfo->count =
         intersect_hotels(tinfo->hotels, tinfo->n_hotels, tinfo->landmarks, tinfo->n_landmarks, tinfo->swapped,
-                         tinfo->type_hotels, t0);
+                         tinfo->type_hotels, t0, tinfo->window);
     t1 = dtime();
     printf("Processed %.2f%% (%ju) of %s in %.2fsecs @ %.2f/sec\n",
            (double)tinfo->count / (double)tinfo->n_hotels * 100.0, (uintmax_t) tinfo->count, tinfo->type_hotels,
@@ -305,7 +1002,8 @@ static void *thread_start(void *arg)
 
 inline static uint64_t partition_intersect_hotels(geopoint_t * const hotels, const uint64_t n_hotels,
                                                   geopoint_t * const landmarks, const uint64_t n_landmarks,
-                                                  const uint64_t swapped, const char *type_hotels, double t0)
+                                                  const uint64_t swapped, const char *type_hotels, double t0,
+                                                  const double window)
 {
     struct thread_info tinfo[NUM_THREADS];
     uint64_t incr = (n_hotels + NUM_THREADS - 1) / NUM_THREADS;
@@ -332,6 +1030,7 @@ inline static uint64_t partition_intersect_hotels(geopoint_t * const hotels, con
         tinfo[i].swapped = swapped;
         tinfo[i].type_hotels = type_hotels;
         tinfo[i].t0 = t0;
+        tinfo[i].window = window;
 
         s = pthread_create(&tinfo[i].thread_id, &attr, &thread_start, &tinfo[i]);
         if (s != 0)
@@ -360,6 +1059,75 @@ inline static uint64_t partition_intersect_hotels(geopoint_t * const hotels, con
 }
 #endif
 
+static inline uint64_t *save_wide_bands(geopoint_t * const points, const uint64_t n_points)
+{
+    uint64_t *saved = malloc(sizeof(uint64_t) * APPROX_BANDS * (n_points ? n_points : 1));
+    uint64_t i;
+
+    assert(saved);
+    for (i = 0; i < n_points; i++) {
+        memcpy(saved + i * APPROX_BANDS, points[i].dist, sizeof(uint64_t) * APPROX_BANDS);
+        bzero(points[i].dist, sizeof(uint64_t) * 6);
+    }
+    return saved;
+}
+
+/* compare the approximate wide bands against the exact counts now in points, then put them back */
+static inline void report_wide_error(geopoint_t * const points, const uint64_t n_points, uint64_t * saved,
+                                     const char *type)
+{
+    uint64_t i;
+    int b;
+
+    for (b = 0; b < APPROX_BANDS; b++) {
+        double approx_sum = 0.0, exact_sum = 0.0, max_rel = 0.0;
+        uint64_t max_abs = 0, n_diff = 0, n_zero = 0;
+
+        for (i = 0; i < n_points; i++) {
+            uint64_t approx = saved[i * APPROX_BANDS + b];
+            uint64_t exact = points[i].dist[b];
+            uint64_t diff = approx > exact ? approx - exact : exact - approx;
+
+            approx_sum += (double)approx * (double)points[i].weight;
+            exact_sum += (double)exact * (double)points[i].weight;
+            if (diff) {
+                n_diff += points[i].weight;
+                if (diff > max_abs)
+                    max_abs = diff;
+                /* no ratio against 0, and the worst kind of miss */
+                if (!exact)
+                    n_zero += points[i].weight;
+                else if ((double)diff / (double)exact > max_rel)
+                    max_rel = (double)diff / (double)exact;
+            }
+        }
+        printf("Approx %s %2.0fkm: total error %.4f%%, %ju points differ, max error %ju (%.2f%%), "
+               "%ju nonzero where exact is 0\n",
+               type, approx_radius[b], exact_sum ? (approx_sum - exact_sum) / exact_sum * 100.0 : 0.0,
+               (uintmax_t) n_diff, (uintmax_t) max_abs, max_rel * 100.0, (uintmax_t) n_zero);
+    }
+
+    for (i = 0; i < n_points; i++)
+        memcpy(points[i].dist, saved + i * APPROX_BANDS, sizeof(uint64_t) * APPROX_BANDS);
+    free(saved);
+}
+
+/* --check: rerun the full 50km sweep and report how far the grid answers are from it */
+static void check_approx_wide(geopoint_t * const hotels, const uint64_t n_hotels,
+                              geopoint_t * const landmarks, const uint64_t n_landmarks, const uint64_t swapped,
+                              const char *type_hotels, const char *type_landmarks)
+{
+    uint64_t *saved_hotels = save_wide_bands(hotels, n_hotels);
+    uint64_t *saved_landmarks = save_wide_bands(landmarks, n_landmarks);
+    double t0 = dtime();
+
+    INTERSECT(hotels, n_hotels, landmarks, n_landmarks, swapped, type_hotels, t0, 50.0);
+    printf("Exact sweep for --check took %.2fsecs\n", SECS(dtime() - t0));
+
+    report_wide_error(hotels, n_hotels, saved_hotels, type_hotels);
+    report_wide_error(landmarks, n_landmarks, saved_landmarks, type_landmarks);
+}
+
 int main(int argc, char **argv)
 {
     uint64_t n_hotels = 0;
@@ -379,16 +1147,61 @@ int main(int argc, char **argv)
     double t1;
     uint64_t swapped = 0;
     char outname[1024];
+    int collapse_dups = 0;
+    int approx_wide = 0;
+    int check = 0;
+    int engine_tiles = 0;
+    int cache_fds[CACHE_EVENTS];
+    int *engine_fds = NULL;     /* cache counters, only with --engine */
+    int argi = 1;
+    geopoint_t *join_hotels;
+    geopoint_t *join_landmarks;
+    uint64_t n_join_hotels;
+    uint64_t n_join_landmarks;
+    double window;
+
+    for (; argi < argc && !strncmp(argv[argi], "--", 2); argi++) {
+        if (!strcmp(argv[argi], "--collapse-dups")) {
+            collapse_dups = 1;
+        } else if (!strcmp(argv[argi], "--approx-wide")) {
+            approx_wide = 1;
+        } else if (!strcmp(argv[argi], "--check")) {
+            check = 1;
+        } else if (!strcmp(argv[argi], "--engine") && argi + 1 < argc) {
+            argi++;
+            engine_fds = cache_fds;
+            if (!strcmp(argv[argi], "tiles")) {
+                engine_tiles = 1;
+            } else if (!strcmp(argv[argi], "sweep")) {
+                engine_tiles = 0;
+            } else {
+                printf("Unknown engine '%s', expected sweep or tiles\n", argv[argi]);
+                exit(1);
+            }
+        } else {
+            printf("Unknown option '%s'\n", argv[argi]);
+            exit(1);
+        }
+    }
 
-    if (argc < 3) {
-        printf("intersect H L\n");
+    if (argc - argi < 2) {
+        printf("intersect [--engine sweep|tiles] [--collapse-dups] [--approx-wide [--check]] H L\n");
         exit(0);
     }
 
-    name_hotels = argv[1];
+    if (check && !approx_wide) {
+        printf("--check only applies to --approx-wide\n");
+        exit(1);
+    }
+    if (approx_wide && engine_tiles) {
+        printf("--approx-wide only pays off against the sweep, not with --engine tiles\n");
+        exit(1);
+    }
+
+    name_hotels = argv[argi];
     hotels = read_geopoints(name_hotels, &n_hotels, type_hotels);
 
-    name_landmarks = argv[2];
+    name_landmarks = argv[argi + 1];
     landmarks = read_geopoints(name_landmarks, &n_landmarks, type_landmarks);
 
     if (n_hotels < n_landmarks) {
@@ -414,14 +1227,55 @@ int main(int argc, char **argv)
     assert(hotels);
     assert(landmarks);
 
-    count = INTERSECT(hotels, n_hotels, landmarks, n_landmarks, swapped, type_hotels, t0);
+    window = approx_wide ? APPROX_WINDOW : 50.0;
+    join_hotels = hotels;
+    join_landmarks = landmarks;
+    n_join_hotels = n_hotels;
+    n_join_landmarks = n_landmarks;
+
+    if (collapse_dups) {
+        uint64_t pairs = sweep_candidates(hotels, n_hotels, landmarks, n_landmarks, window);
+        uint64_t uniq_pairs;
+
+        join_hotels = collapse_geopoints(hotels, n_hotels, &n_join_hotels, type_hotels);
+        join_landmarks = collapse_geopoints(landmarks, n_landmarks, &n_join_landmarks, type_landmarks);
+        uniq_pairs = sweep_candidates(join_hotels, n_join_hotels, join_landmarks, n_join_landmarks, window);
+        printf("Sweep candidate pairs shrank from %ju to %ju (%.2f%% of original)\n",
+               (uintmax_t) pairs, (uintmax_t) uniq_pairs, pairs ? (double)uniq_pairs / (double)pairs * 100.0 : 100.0);
+        t0 = dtime();
+    }
+
+    if (engine_tiles) {
+        count = intersect_tiles(join_hotels, n_join_hotels, join_landmarks, n_join_landmarks, swapped, type_hotels,
+                                t0, window, engine_fds);
+    } else {
+        cache_counters_start(engine_fds);
+        count = INTERSECT(join_hotels, n_join_hotels, join_landmarks, n_join_landmarks, swapped, type_hotels, t0,
+                          window);
+        cache_counters_report(engine_fds);
+    }
 
     t1 = dtime();
-    printf("Processed %.2f%% (%ju) of %s in %.2fsecs @ %.2f/sec\n",
-           (double)count / (double)n_hotels * 100.0, (uintmax_t) count, type_hotels, SECS(t1 - t0),
-           count / SECS(t1 - t0));
+    printf("Processed %.2f%% (%ju) of %s%s in %.2fsecs @ %.2f/sec\n",
+           (double)count / (double)n_join_hotels * 100.0, (uintmax_t) count, collapse_dups ? "unique " : "",
+           type_hotels, SECS(t1 - t0), count / SECS(t1 - t0));
     fflush(stdout);
 
+    if (approx_wide) {
+        approx_wide_bands(join_hotels, n_join_hotels, join_landmarks, n_join_landmarks, swapped);
+        if (check)
+            check_approx_wide(join_hotels, n_join_hotels, join_landmarks, n_join_landmarks, swapped,
+                              type_hotels, type_landmarks);
+    }
+
+    if (collapse_dups) {
+        expand_geopoints(join_hotels, n_join_hotels, hotels);
+        expand_geopoints(join_landmarks, n_join_landmarks, landmarks);
+        free(join_hotels);
+        free(join_landmarks);
+    }
+    t1 = dtime();
+
     sprintf(outname, "%s.out", name_hotels);
     print_results(outname, hotels, n_hotels);
 